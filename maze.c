@@ -1,9 +1,16 @@
 /* maze generation program */
 
 #include <GL/glut.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 /* some useful constants */
 #define TRUE 1
@@ -25,10 +32,27 @@ typedef struct {
   int draw;   /* edge should be drawn */
 } Edge;
 
+/* axis aligned box */
+typedef struct {
+  float x0, y0;   /* lower left corner */
+  float x1, y1;   /* upper right corner */
+} Box;
+
+/* movement request for collide_batch */
+typedef struct {
+  GLfloat x, y;     /* start, replaced by where the mover ends up */
+  GLfloat dx, dy;   /* requested displacement */
+  GLfloat radius;   /* radius of the mover */
+  int hit;          /* set if a wall was touched on the way */
+} MoveRequest;
+
+/* wall mask bits, one per side of a cell */
+#define WALL_LEFT   1
+#define WALL_RIGHT  2
+#define WALL_BOTTOM 4
+#define WALL_TOP    8
+
 /* global parameters */
-int w, h, edges, vedges, perimeters, vertices, groups, *group, redges, done=0;
-Edge *edge, *perimeter;
-Point2 *vertex;
 GLfloat wall_width  = .1;
 GLfloat wall_height = .3;
 GLfloat wall_spacing = .5;
@@ -48,169 +72,259 @@ GLfloat PI = 3.14159265;
 GLfloat theta = 3*3.14159265/2;
 GLfloat turnSpeed = 3;
 GLfloat stepDistance = .1;
-GLfloat xoff, yoff;
-
-GLint col0, row0;
+GLfloat player_radius = .05;  /* half a wall width */
 
 #define numPoints 30
 
 int topView = 0;
 
-int **hWalls, **vWalls;
+/* top view texture, one texel per cell edge.  rebuilt from hWalls and
+   vWalls the next time it is drawn after topTextureDirty is set. */
+GLuint topTexture = 0;
+int topTextureDirty = TRUE;
+GLint maxTextureSize = 0;   /* read on the gl thread at startup */
 
-/* init_maze initializes a w1 by h1 maze.  all walls are initially
-   included.  the edge and perimeter arrays, vertex array, and group
-   array are allocated and filled in.  */
+/* benchmark and camera path recording.  with -r every keypress
+   appends the camera to a path file, with -b the path is replayed
+   headless and the frame times are reported as csv. */
+char *benchFile = NULL;
+FILE *recordFile = NULL;
+int seed = 1;
+long frameVertices;   /* vertices sent in the current frame */
 
-void
+/* tree index over a finished maze.  the maze is a spanning tree of
+   the cells, so the path between two cells is unique and its length
+   is depth[a] + depth[b] - 2*depth[lca(a,b)].  the lowest common
+   ancestor is found with a range minimum query over an euler tour of
+   the tree.  the tour is cut into blocks of about log2(tours) entries
+   and a sparse table over the shallowest cell of each block covers
+   whole blocks, so a query scans at most two partial blocks.  the
+   whole index takes at most 7 ints per cell, 450 MB for a 4000 by
+   4000 maze.  a sparse table over every tour entry would take
+   2*log2(2*cells) ints per cell, 3.2 GB at that size. */
+typedef struct {
+  int cells;    /* number of cells in the tree */
+  int *parent;  /* parent of each cell, -1 for the root */
+  int *depth;   /* distance of each cell from the root */
+  int *first;   /* first position of each cell in the euler tour */
+  int *euler;   /* euler tour of the tree */
+  int tours;    /* length of the euler tour, 2*cells - 1 */
+  int block;    /* number of tour entries in a block */
+  int blocks;   /* number of blocks */
+  int levels;   /* number of rows in the sparse table */
+  int **sparse; /* sparse[k][i] is the shallowest cell in blocks
+                   i .. i + 2^k - 1 */
+  int *lg;      /* lg[n] is floor(log2(n)) for n up to blocks */
+} TreeIndex;
+
+/* maze structure.  everything generated for one maze lives here so a
+   new maze can be built on a worker thread while the current one is
+   drawn. */
+typedef struct {
+  int w, h;       /* size in cells */
+  int edges, vedges, perimeters, vertices, groups, redges, done;
+  int *group;
+  Edge *edge, *perimeter;
+  Point2 *vertex;
+  GLfloat xoff, yoff;   /* offsets that center the maze */
+  GLint col0, row0;     /* entrance */
+  int **hWalls, **vWalls;
+  Point2 *walls;  /* endpoints of the walls to draw, two per wall */
+  int nwalls;
+  TreeIndex tree;
+  unsigned char *wallMask;  /* WALL_ bits of every cell */
+  Box *clearance;       /* where a mover of clearRadius can't touch a
+                           wall, per cell */
+  GLfloat clearRadius;
+} Maze;
+
+/* the maze being drawn, and the next one once the worker thread has
+   finished it.  display() swaps them at the start of a frame. */
+Maze *maze;
+Maze *_Atomic nextMaze = NULL;
+atomic_int generating = 0;
+
+char *indexFile = NULL;
+
+int**
+makeWallArray(int rows, int cols) {
+	int i,j;
+	int** arr;
+    arr = (int**) malloc(rows * sizeof(int*));
+	for (i = 0; i < rows; i++) {
+	   arr[i] = (int *) malloc(cols*sizeof(int));
+	   for (j=0; j < cols; j++){
+		   arr[i][j]=1;
+	   }
+	}
+	return arr;
+
+}
+
+/* init_maze allocates and initializes a w1 by h1 maze.  all walls are
+   initially included.  the edge and perimeter arrays, vertex array,
+   group array and wall arrays are allocated and filled in.  */
+
+Maze *
 init_maze(int w1, int h1)
 {
   int i, j, hedges;
   float x, y, t;
+  Maze *m;
+
+  if ((m=calloc(1, sizeof(Maze))) == NULL) {
+    fprintf(stderr, "Could not allocate maze\n");
+    exit(1);
+  }
+  m->w = w1;
+  m->h = h1;
+  m->vWalls = makeWallArray(h1,w1+1);
+  m->hWalls = makeWallArray(h1+1,w1);
 
-  vedges = (w1-1)*h1; /* number of vertical edges */
+  m->vedges = (w1-1)*h1; /* number of vertical edges */
   hedges = (h1-1)*w1; /* number of horizontal edges */
-  redges = edges = vedges + hedges;  /* number of removable edges */
-  perimeters = 2*w1 + 2*h1;
-  vertices = (w1+1)*(h1+1);
-  groups = w1*h1;
+  m->redges = m->edges = m->vedges + hedges;  /* number of removable edges */
+  m->perimeters = 2*w1 + 2*h1;
+  m->vertices = (w1+1)*(h1+1);
+  m->groups = w1*h1;
 
   /* allocate edge array */
-  if ((edge=malloc(edges*sizeof(Edge))) == NULL) {
+  if ((m->edge=malloc(m->edges*sizeof(Edge))) == NULL) {
     fprintf(stderr, "Could not allocate edge table\n");
     exit(1);
   }
 
   /* fill in the vertical edges */
-  for (i=0; i<vedges; i++) {
+  for (i=0; i<m->vedges; i++) {
     x = i%(w1-1); /* convert edge number to column */
     y = i/(w1-1); /* and row */
     j = y*w1 + x; /* convert to cell number */
-    edge[i].cell1 = j;
-    edge[i].cell2 = j+1;
-    edge[i].vertex1 = y*(w1+1) + x+1;   /* convert to vertex number */
-    edge[i].vertex2 = (y+1)*(w1+1) + x+1;
-    edge[i].valid = TRUE;
-    edge[i].draw = TRUE;
-  }
-  for (i=vedges; i<edges; i++) {
-    j = i - vedges; /* convert to cell number */
+    m->edge[i].cell1 = j;
+    m->edge[i].cell2 = j+1;
+    m->edge[i].vertex1 = y*(w1+1) + x+1;   /* convert to vertex number */
+    m->edge[i].vertex2 = (y+1)*(w1+1) + x+1;
+    m->edge[i].valid = TRUE;
+    m->edge[i].draw = TRUE;
+  }
+  for (i=m->vedges; i<m->edges; i++) {
+    j = i - m->vedges; /* convert to cell number */
     x = j%w1;   /* convert edge number to column */
     y = j/w1;   /* and row*/
-    edge[i].cell1 = j;
-    edge[i].cell2 = j + w1;
-    edge[i].vertex1 = (y+1)*(w1+1) + x;   /* convert to vertex number */
-    edge[i].vertex2 = (y+1)*(w1+1) + x+1;
-    edge[i].valid = TRUE;
-    edge[i].draw = TRUE;
+    m->edge[i].cell1 = j;
+    m->edge[i].cell2 = j + w1;
+    m->edge[i].vertex1 = (y+1)*(w1+1) + x;   /* convert to vertex number */
+    m->edge[i].vertex2 = (y+1)*(w1+1) + x+1;
+    m->edge[i].valid = TRUE;
+    m->edge[i].draw = TRUE;
   }
 
   /* allocate perimeter */
-  if ((perimeter=malloc(perimeters*sizeof(Edge))) == NULL) {
+  if ((m->perimeter=malloc(m->perimeters*sizeof(Edge))) == NULL) {
     fprintf(stderr, "Could not allocate perimeter table\n");
     exit(1);
   }
 
   /* fill in horizontal perimeter */
   for (i=0; i<w1; i++) {
-    perimeter[2*i].cell1 = i;
-    perimeter[2*i].cell2 = i;
-    perimeter[2*i].vertex1 = i;
-    perimeter[2*i].vertex2 = i + 1;
-    perimeter[2*i].valid = TRUE;
-    perimeter[2*i].draw = TRUE;
-    perimeter[2*i+1].cell1 = i + h1*w1;
-    perimeter[2*i+1].cell2 = i + h1*w1;
-    perimeter[2*i+1].vertex1 = i + h1*(w1+1);
-    perimeter[2*i+1].vertex2 = i + h1*(w1+1) + 1;
-    perimeter[2*i+1].valid = TRUE;
-    perimeter[2*i+1].draw = TRUE;
+    m->perimeter[2*i].cell1 = i;
+    m->perimeter[2*i].cell2 = i;
+    m->perimeter[2*i].vertex1 = i;
+    m->perimeter[2*i].vertex2 = i + 1;
+    m->perimeter[2*i].valid = TRUE;
+    m->perimeter[2*i].draw = TRUE;
+    m->perimeter[2*i+1].cell1 = i + h1*w1;
+    m->perimeter[2*i+1].cell2 = i + h1*w1;
+    m->perimeter[2*i+1].vertex1 = i + h1*(w1+1);
+    m->perimeter[2*i+1].vertex2 = i + h1*(w1+1) + 1;
+    m->perimeter[2*i+1].valid = TRUE;
+    m->perimeter[2*i+1].draw = TRUE;
   }
   /* fill in vertical perimeter */
   for (i=w1; i<w1+h1; i++) {
     j = i-w1;
-    perimeter[2*i].cell1 = j*w1;
-    perimeter[2*i].cell2 = j*w1;
-    perimeter[2*i].vertex1 = j*(w1+1);
-    perimeter[2*i].vertex2 = (j+1)*(w1+1);
-    perimeter[2*i].valid = TRUE;
-    perimeter[2*i].draw = TRUE;
-    perimeter[2*i+1].cell1 = (j+1)*w1 - 1;
-    perimeter[2*i+1].cell2 = (j+1)*w1 - 1;
-    perimeter[2*i+1].vertex1 = (j+1)*(w1+1) - 1;
-    perimeter[2*i+1].vertex2 = (j+2)*(w1+1) - 1;
-    perimeter[2*i+1].valid = TRUE;
-    perimeter[2*i+1].draw = TRUE;
+    m->perimeter[2*i].cell1 = j*w1;
+    m->perimeter[2*i].cell2 = j*w1;
+    m->perimeter[2*i].vertex1 = j*(w1+1);
+    m->perimeter[2*i].vertex2 = (j+1)*(w1+1);
+    m->perimeter[2*i].valid = TRUE;
+    m->perimeter[2*i].draw = TRUE;
+    m->perimeter[2*i+1].cell1 = (j+1)*w1 - 1;
+    m->perimeter[2*i+1].cell2 = (j+1)*w1 - 1;
+    m->perimeter[2*i+1].vertex1 = (j+1)*(w1+1) - 1;
+    m->perimeter[2*i+1].vertex2 = (j+2)*(w1+1) - 1;
+    m->perimeter[2*i+1].valid = TRUE;
+    m->perimeter[2*i+1].draw = TRUE;
   }
 
   /* allocate vertex array */
-  if ((vertex=malloc(vertices*sizeof(Point2))) == NULL) {
+  if ((m->vertex=malloc(m->vertices*sizeof(Point2))) == NULL) {
     fprintf(stderr, "Could not allocate vertex table\n");
     exit(1);
   }
 
   /* determine the required offsets to center the maze using the
      spacing calculated above */
-  xoff = -w1*wall_spacing/2;
-  yoff = -h1*wall_spacing/2;
+  m->xoff = -w1*wall_spacing/2;
+  m->yoff = -h1*wall_spacing/2;
   /* fill in the vertex array */
-  for (i=0; i<vertices; i++) {
+  for (i=0; i<m->vertices; i++) {
     x = i%(w1+1);
     y = i/(w1+1);
-    vertex[i].x = x*wall_spacing + xoff;
-    vertex[i].y = y*wall_spacing + yoff;
+    m->vertex[i].x = x*wall_spacing + m->xoff;
+    m->vertex[i].y = y*wall_spacing + m->yoff;
   }
 
   /* allocate the group table */
-  if ((group=malloc(groups*sizeof(int))) == NULL) {
+  if ((m->group=malloc(m->groups*sizeof(int))) == NULL) {
     fprintf(stderr, "Could not allocate group table\n");
     exit(1);
   }
 
   /* set the group table to the identity */
-  for (i=0; i<groups; i++) {
-    group[i] = i;
+  for (i=0; i<m->groups; i++) {
+    m->group[i] = i;
   }
+  return m;
 }
 
 /* this function removes one wall from the maze.  if removing this
    wall connects all cells, an entrance and exit are created and a
    done flag is set */
 void
-step_maze(void)
+step_maze(Maze *m)
 {
-  int i, j, k, o, n, row, col, m;
+  int i, j, k, o, n, row, col;
 
   /* randomly select one of the the remaining walls */
-  k = rand()%redges;
+  k = rand()%m->redges;
   /* scan down the edge array till we find the kth removeable edge */
-  for (i=0; i<edges; i++) {
-    if (edge[i].valid == TRUE) {
+  for (i=0; i<m->edges; i++) {
+    if (m->edge[i].valid == TRUE) {
       if (k == 0) {
-        edge[i].valid = FALSE;
-        n = group[edge[i].cell1];
-        o = group[edge[i].cell2];
+        m->edge[i].valid = FALSE;
+        n = m->group[m->edge[i].cell1];
+        o = m->group[m->edge[i].cell2];
         /* if the cells are already connected don't remove the wall */
         if (n != o) {
-		  if (i < vedges) {
-			col = 1+i%(w-1);
-			row = i/(w-1);
-			vWalls[row][col]=0;
+		  if (i < m->vedges) {
+			col = 1+i%(m->w-1);
+			row = i/(m->w-1);
+			m->vWalls[row][col]=0;
 		} else {
-			j = i-vedges;
-			col = j%w;
-			row = 1+j/w;
-			hWalls[row][col]=0;
+			j = i-m->vedges;
+			col = j%m->w;
+			row = 1+j/m->w;
+			m->hWalls[row][col]=0;
 		}
-          edge[i].draw = FALSE;
-          done = 1;
+          m->edge[i].draw = FALSE;
+          m->done = 1;
           /* fix up the group array */
-          for (j=0; j<groups; j++) {
-            if (group[j] == o) {
-              group[j] = n;
+          for (j=0; j<m->groups; j++) {
+            if (m->group[j] == o) {
+              m->group[j] = n;
             }
-            if (group[j] != n) {
-              done = 0;     /* if we have more than one
+            if (m->group[j] != n) {
+              m->done = 0;     /* if we have more than one
                                group we're not done */
             }
           }
@@ -222,35 +336,35 @@ step_maze(void)
       }
     }
   }
-  redges--; /* decriment the number of removable edges */
+  m->redges--; /* decriment the number of removable edges */
   /* if we're done, create an entrance and exit */
   
-  if (done) {
+  if (m->done) {
     for (j=0; j<2; j++) {
       /* randomly select a perimeter edge */
-      k = rand()%(perimeters-j);
-      for (i=0; i<perimeters; i++) {
+      k = rand()%(m->perimeters-j);
+      for (i=0; i<m->perimeters; i++) {
         if (k == 0) {
 			 //printf("\n%d",i);
-    	if (i < 2*w) {
+    	if (i < 2*m->w) {
 				col = floor(i/2);
-				row = (h)*(i%2);
-				row0 = row;
-				col0 = col;
+				row = (m->h)*(i%2);
+				m->row0 = row;
+				m->col0 = col;
 				//printf("\nROW: %d\nCOL: %d\n",row,col);
 				//fflush(stdout);
-				hWalls[row][col]=0;
+				m->hWalls[row][col]=0;
 			} else {
-				row = floor((i-2*w)/2);
-				col = (w)*(i%2);
-				row0 = row;
-				col0 = col;
+				row = floor((i-2*m->w)/2);
+				col = (m->w)*(i%2);
+				m->row0 = row;
+				m->col0 = col;
 				//printf("\nROW: %d\nCOL: %d\n",row,col);
 				//fflush(stdout);
-				vWalls[row][col]=0;
+				m->vWalls[row][col]=0;
 			}
-          if (perimeter[i].valid == TRUE) {
-            perimeter[i].draw = FALSE;
+          if (m->perimeter[i].valid == TRUE) {
+            m->perimeter[i].draw = FALSE;
             break;
           }
         }
@@ -262,6 +376,766 @@ step_maze(void)
   }
 }
 
+/* cell_neighbours fills n with the cells reachable from cell without
+   crossing a wall and returns how many there are */
+int
+cell_neighbours(Maze *m, int cell, int *n)
+{
+  int row = cell/m->w, col = cell%m->w, k = 0;
+
+  if (col > 0 && !m->vWalls[row][col])
+    n[k++] = cell - 1;
+  if (col < m->w-1 && !m->vWalls[row][col+1])
+    n[k++] = cell + 1;
+  if (row > 0 && !m->hWalls[row][col])
+    n[k++] = cell - m->w;
+  if (row < m->h-1 && !m->hWalls[row+1][col])
+    n[k++] = cell + m->w;
+  return k;
+}
+
+/* free_tree_index releases the arrays of the tree index */
+void
+free_tree_index(Maze *m)
+{
+  int k;
+
+  for (k=0; k<m->tree.levels; k++) {
+    free(m->tree.sparse[k]);
+  }
+  free(m->tree.sparse);
+  free(m->tree.parent);
+  free(m->tree.depth);
+  free(m->tree.first);
+  free(m->tree.euler);
+  free(m->tree.lg);
+  m->tree.sparse = NULL;
+  m->tree.parent = m->tree.depth = m->tree.first = m->tree.euler = m->tree.lg = NULL;
+  m->tree.levels = m->tree.cells = m->tree.tours = 0;
+  m->tree.block = m->tree.blocks = 0;
+}
+
+/* build_wall_list collects the endpoints of every wall that is still
+   standing, interior edges followed by the perimeter, so draw_maze
+   doesn't have to scan the edge tables */
+void
+build_wall_list(Maze *m)
+{
+  int i, n = 0;
+
+  for (i=0; i<m->edges; i++) {
+    n += m->edge[i].draw == TRUE;
+  }
+  for (i=0; i<m->perimeters; i++) {
+    n += m->perimeter[i].draw == TRUE;
+  }
+  free(m->walls);
+  if ((m->walls=malloc(2*n*sizeof(Point2))) == NULL) {
+    fprintf(stderr, "Could not allocate wall list\n");
+    exit(1);
+  }
+  m->nwalls = 0;
+  for (i=0; i<m->edges; i++) {
+    if (m->edge[i].draw == TRUE) {
+      m->walls[2*m->nwalls] = m->vertex[m->edge[i].vertex1];
+      m->walls[2*m->nwalls+1] = m->vertex[m->edge[i].vertex2];
+      m->nwalls++;
+    }
+  }
+  for (i=0; i<m->perimeters; i++) {
+    if (m->perimeter[i].draw == TRUE) {
+      m->walls[2*m->nwalls] = m->vertex[m->perimeter[i].vertex1];
+      m->walls[2*m->nwalls+1] = m->vertex[m->perimeter[i].vertex2];
+      m->nwalls++;
+    }
+  }
+}
+
+/* free_maze releases a maze and everything built for it */
+void
+free_maze(Maze *m)
+{
+  int i;
+
+  for (i=0; i<m->h; i++) {
+    free(m->vWalls[i]);
+  }
+  for (i=0; i<=m->h; i++) {
+    free(m->hWalls[i]);
+  }
+  free(m->vWalls);
+  free(m->hWalls);
+  free(m->edge);
+  free(m->perimeter);
+  free(m->vertex);
+  free(m->group);
+  free(m->walls);
+  free(m->wallMask);
+  free(m->clearance);
+  free_tree_index(m);
+  free(m);
+}
+
+/* alloc_tree_index allocates the per cell arrays of the tree index
+   of maze m */
+void
+alloc_tree_index(Maze *m)
+{
+  free_tree_index(m);
+  m->tree.cells = m->w*m->h;
+  m->tree.tours = 2*m->tree.cells - 1;
+  m->tree.parent = malloc(m->tree.cells*sizeof(int));
+  m->tree.depth = malloc(m->tree.cells*sizeof(int));
+  m->tree.first = malloc(m->tree.cells*sizeof(int));
+  m->tree.euler = malloc(m->tree.tours*sizeof(int));
+  if (!m->tree.parent || !m->tree.depth || !m->tree.first || !m->tree.euler) {
+    fprintf(stderr, "Could not allocate tree index\n");
+    exit(1);
+  }
+}
+
+/* shallower returns whichever of cells a and b is nearer the root */
+int
+shallower(Maze *m, int a, int b)
+{
+  return m->tree.depth[a] <= m->tree.depth[b] ? a : b;
+}
+
+/* build_sparse_table fills in the range minimum table over the blocks
+   of the euler tour.  row k holds the shallowest cell of every run of
+   2^k blocks, so any run of whole blocks is covered by two
+   overlapping runs. */
+void
+build_sparse_table(Maze *m)
+{
+  int i, k, b, n;
+
+  for (b=1, k=m->tree.tours; k>1; k/=2) {
+    b++;
+  }
+  m->tree.block = b;
+  m->tree.blocks = n = (m->tree.tours + b - 1)/b;
+  if ((m->tree.lg=malloc((n+1)*sizeof(int))) == NULL) {
+    fprintf(stderr, "Could not allocate tree index\n");
+    exit(1);
+  }
+  m->tree.lg[0] = m->tree.lg[1] = 0;
+  for (i=2; i<=n; i++) {
+    m->tree.lg[i] = m->tree.lg[i/2] + 1;
+  }
+  m->tree.levels = m->tree.lg[n] + 1;
+  if ((m->tree.sparse=malloc(m->tree.levels*sizeof(int*))) == NULL) {
+    fprintf(stderr, "Could not allocate tree index\n");
+    exit(1);
+  }
+  for (k=0; k<m->tree.levels; k++) {
+    if ((m->tree.sparse[k]=malloc((n - (1<<k) + 1)*sizeof(int))) == NULL) {
+      fprintf(stderr, "Could not allocate tree index\n");
+      exit(1);
+    }
+  }
+  for (i=0; i<m->tree.tours; i++) {
+    if (i%b == 0) {
+      m->tree.sparse[0][i/b] = m->tree.euler[i];
+    } else {
+      m->tree.sparse[0][i/b] = shallower(m, m->tree.sparse[0][i/b], m->tree.euler[i]);
+    }
+  }
+  for (k=1; k<m->tree.levels; k++) {
+    for (i=0; i + (1<<k) <= n; i++) {
+      m->tree.sparse[k][i] = shallower(m, m->tree.sparse[k-1][i],
+                                       m->tree.sparse[k-1][i + (1<<(k-1))]);
+    }
+  }
+}
+
+/* build_tree_index walks the finished maze from cell 0 and records
+   the parent and depth of every cell along with an euler tour, then
+   builds the sparse table used to answer lowest common ancestor
+   queries in O(log cells) time.  the walk uses an explicit stack since
+   the tree can be as deep as the number of cells.  returns FALSE if
+   the walls don't make a spanning tree, which only happens for a
+   damaged maze file. */
+int
+build_tree_index(Maze *m)
+{
+  int *stack, *next, sp, t, cell, k, count, n[4], ok = TRUE;
+
+  alloc_tree_index(m);
+  stack = malloc(m->tree.cells*sizeof(int));
+  next = malloc(m->tree.cells*sizeof(int));
+  if (!stack || !next) {
+    fprintf(stderr, "Could not allocate tree index\n");
+    exit(1);
+  }
+
+  for (k=0; k<m->tree.cells; k++) {
+    m->tree.depth[k] = -1;
+  }
+  t = 0;
+  sp = 0;
+  stack[sp++] = 0;
+  next[0] = 0;
+  m->tree.parent[0] = -1;
+  m->tree.depth[0] = 0;
+  m->tree.first[0] = t;
+  m->tree.euler[t++] = 0;
+  while (sp > 0) {
+    cell = stack[sp-1];
+    count = cell_neighbours(m, cell, n);
+    /* skip back over the edge we came in on */
+    while (next[cell] < count && n[next[cell]] == m->tree.parent[cell]) {
+      next[cell]++;
+    }
+    if (next[cell] < count) {
+      k = n[next[cell]++];
+      if (m->tree.depth[k] >= 0) {
+        ok = FALSE;   /* reached twice, the walls have a loop */
+        break;
+      }
+      m->tree.parent[k] = cell;
+      m->tree.depth[k] = m->tree.depth[cell] + 1;
+      m->tree.first[k] = t;
+      m->tree.euler[t++] = k;
+      next[k] = 0;
+      stack[sp++] = k;
+    } else {
+      sp--;
+      if (sp > 0) {
+        m->tree.euler[t++] = stack[sp-1];
+      }
+    }
+  }
+  free(stack);
+  free(next);
+  if (!ok || t != m->tree.tours) {
+    return FALSE;   /* loop, or some cells can't be reached */
+  }
+
+  build_sparse_table(m);
+  return TRUE;
+}
+
+/* maze_lca returns the lowest common ancestor of cells a and b, the
+   shallowest cell in the euler tour between their first visits.  the
+   partial blocks at either end are scanned and the whole blocks in
+   between looked up in the sparse table, so this takes O(log cells)
+   time. */
+int
+maze_lca(Maze *m, int a, int b)
+{
+  int l = m->tree.first[a], r = m->tree.first[b], k, x, bl, br;
+  int *euler = m->tree.euler;
+
+  if (l > r) {
+    k = l; l = r; r = k;
+  }
+  bl = l/m->tree.block;
+  br = r/m->tree.block;
+  x = euler[l];
+  if (bl == br) {
+    for (k=l+1; k<=r; k++) {
+      x = shallower(m, x, euler[k]);
+    }
+    return x;
+  }
+  for (k=l+1; k<(bl+1)*m->tree.block; k++) {
+    x = shallower(m, x, euler[k]);
+  }
+  for (k=br*m->tree.block; k<=r; k++) {
+    x = shallower(m, x, euler[k]);
+  }
+  if (br - bl > 1) {
+    k = m->tree.lg[br - bl - 1];
+    x = shallower(m, x, m->tree.sparse[k][bl + 1]);
+    x = shallower(m, x, m->tree.sparse[k][br - (1<<k)]);
+  }
+  return x;
+}
+
+/* maze_distance returns the number of steps between cells a and b
+   along the maze */
+int
+maze_distance(Maze *m, int a, int b)
+{
+  return m->tree.depth[a] + m->tree.depth[b] - 2*m->tree.depth[maze_lca(m, a, b)];
+}
+
+/* maze_path writes the cells on the path from a to b, both included,
+   into path and returns how many were written.  path must have room
+   for maze_distance(a, b) + 1 cells. */
+int
+maze_path(Maze *m, int a, int b, int *path)
+{
+  int l = maze_lca(m, a, b), n, i, cell;
+
+  n = m->tree.depth[a] + m->tree.depth[b] - 2*m->tree.depth[l] + 1;
+  i = 0;
+  for (cell=a; cell!=l; cell=m->tree.parent[cell]) {
+    path[i++] = cell;
+  }
+  path[i] = l;
+  i = n - 1;
+  for (cell=b; cell!=l; cell=m->tree.parent[cell]) {
+    path[i--] = cell;
+  }
+  return n;
+}
+
+/* sync_edges sets the draw flags of the edge and perimeter arrays
+   from hWalls and vWalls, the reverse of what step_maze does */
+void
+sync_edges(Maze *m)
+{
+  int i, j;
+
+  for (i=0; i<m->edges; i++) {
+    if (i < m->vedges) {
+      m->edge[i].draw = m->vWalls[i/(m->w-1)][1+i%(m->w-1)];
+    } else {
+      j = i - m->vedges;
+      m->edge[i].draw = m->hWalls[1+j/m->w][j%m->w];
+    }
+    m->edge[i].valid = FALSE;
+  }
+  for (i=0; i<m->perimeters; i++) {
+    if (i < 2*m->w) {
+      m->perimeter[i].draw = m->hWalls[m->h*(i%2)][i/2];
+    } else {
+      m->perimeter[i].draw = m->vWalls[(i-2*m->w)/2][m->w*(i%2)];
+    }
+  }
+}
+
+#define INDEX_MAGIC 0x585a414d  /* "MAZX" */
+
+/* save_maze writes the walls and entrance of the maze to file.  the
+   tree index is not saved, it is rebuilt on load.  returns 0 on
+   success. */
+int
+save_maze(Maze *m, char *file)
+{
+  FILE *fp;
+  int i, ok, hdr[5];
+
+  if ((fp=fopen(file, "wb")) == NULL) {
+    fprintf(stderr, "Could not open %s for writing\n", file);
+    return -1;
+  }
+  hdr[0] = INDEX_MAGIC;
+  hdr[1] = m->w;
+  hdr[2] = m->h;
+  hdr[3] = m->row0;
+  hdr[4] = m->col0;
+  ok = fwrite(hdr, sizeof(int), 5, fp) == 5;
+  for (i=0; ok && i<m->h; i++) {
+    ok = fwrite(m->vWalls[i], sizeof(int), m->w+1, fp) == m->w+1;
+  }
+  for (i=0; ok && i<=m->h; i++) {
+    ok = fwrite(m->hWalls[i], sizeof(int), m->w, fp) == m->w;
+  }
+  if (fclose(fp) != 0 || !ok) {
+    fprintf(stderr, "Could not write %s\n", file);
+    return -1;
+  }
+  return 0;
+}
+
+/* load_maze reads a maze saved by save_maze into the maze m, which
+   must come straight from init_maze with the same size, and builds
+   its tree index.  returns 0 on success, in which case the maze is
+   done, -1 if there is no such file and -2 if it can't be used.  on
+   failure m may be partly overwritten and should be thrown away. */
+int
+load_maze(Maze *m, char *file)
+{
+  FILE *fp;
+  int i, j, ok, hdr[5];
+
+  if ((fp=fopen(file, "rb")) == NULL) {
+    if (errno == ENOENT) {
+      return -1;
+    }
+    fprintf(stderr, "Could not open %s\n", file);
+    return -2;
+  }
+  if (fread(hdr, sizeof(int), 5, fp) != 5 || hdr[0] != INDEX_MAGIC) {
+    fprintf(stderr, "%s is not a maze file\n", file);
+    fclose(fp);
+    return -2;
+  }
+  if (hdr[1] != m->w || hdr[2] != m->h) {
+    fprintf(stderr, "%s does not hold a %d by %d maze\n", file, m->w, m->h);
+    fclose(fp);
+    return -2;
+  }
+  ok = hdr[3] >= 0 && hdr[3] <= m->h && hdr[4] >= 0 && hdr[4] <= m->w;
+  for (i=0; ok && i<m->h; i++) {
+    ok = fread(m->vWalls[i], sizeof(int), m->w+1, fp) == m->w+1;
+    for (j=0; ok && j<=m->w; j++) {
+      ok = m->vWalls[i][j] == 0 || m->vWalls[i][j] == 1;
+    }
+  }
+  for (i=0; ok && i<=m->h; i++) {
+    ok = fread(m->hWalls[i], sizeof(int), m->w, fp) == m->w;
+    for (j=0; ok && j<m->w; j++) {
+      ok = m->hWalls[i][j] == 0 || m->hWalls[i][j] == 1;
+    }
+  }
+  fclose(fp);
+  if (!ok || !build_tree_index(m)) {
+    fprintf(stderr, "%s is damaged\n", file);
+    return -2;
+  }
+  m->row0 = hdr[3];
+  m->col0 = hdr[4];
+  sync_edges(m);
+  m->done = 1;
+  return 0;
+}
+
+/* build_collision fills in the wall mask and clearance tables of a
+   finished maze.  walls are drawn from their edge towards +x or -y,
+   so inside a cell only its own left and top walls take up room.  a
+   circle of the given radius centred in the clearance box of a cell
+   can't touch any wall, of that cell or a neighbour. */
+void
+build_collision(Maze *m, GLfloat radius)
+{
+  int r, c, k, mask;
+  float x, y;
+
+  free(m->wallMask);
+  free(m->clearance);
+  m->wallMask = malloc(m->w*m->h);
+  m->clearance = malloc(m->w*m->h*sizeof(Box));
+  if (!m->wallMask || !m->clearance) {
+    fprintf(stderr, "Could not allocate collision tables\n");
+    exit(1);
+  }
+  m->clearRadius = radius;
+  for (r=0; r<m->h; r++) {
+    for (c=0; c<m->w; c++) {
+      k = r*m->w + c;
+      mask = 0;
+      if (m->vWalls[r][c]) mask |= WALL_LEFT;
+      if (m->vWalls[r][c+1]) mask |= WALL_RIGHT;
+      if (m->hWalls[r][c]) mask |= WALL_BOTTOM;
+      if (m->hWalls[r+1][c]) mask |= WALL_TOP;
+      m->wallMask[k] = mask;
+      x = c*wall_spacing + m->xoff;
+      y = r*wall_spacing + m->yoff;
+      m->clearance[k].x0 = x + (mask & WALL_LEFT ? wall_width : 0) + radius;
+      m->clearance[k].x1 = x + wall_spacing - radius;
+      m->clearance[k].y0 = y + radius;
+      m->clearance[k].y1 = y + wall_spacing - (mask & WALL_TOP ? wall_width : 0) - radius;
+    }
+  }
+}
+
+/* sweep_circle finds when a circle of radius r moving from (px, py)
+   by (dx, dy) first touches the point (cx, cy).  updates *t and
+   returns TRUE if that is sooner than *t. */
+int
+sweep_circle(float px, float py, float dx, float dy, float r,
+             float cx, float cy, float *t)
+{
+  float ox = px - cx, oy = py - cy;
+  float a = dx*dx + dy*dy, b = ox*dx + oy*dy, c = ox*ox + oy*oy - r*r;
+  float disc = b*b - a*c, s;
+
+  if (a == 0 || b >= 0 || disc < 0) {
+    return FALSE;
+  }
+  /* a circle just touching the point comes out slightly negative */
+  s = (-b - sqrt(disc))/a;
+  if (s < 0) {
+    s = 0;
+  }
+  if (s >= *t) {
+    return FALSE;
+  }
+  *t = s;
+  return TRUE;
+}
+
+/* sweep_slab finds when the point (px, py) moving by (dx, dy) enters
+   the box b.  updates *t and returns which axis it came in on, 1 for
+   x and 2 for y, if that is sooner than *t, otherwise 0. */
+int
+sweep_slab(float px, float py, float dx, float dy, Box b, float *t)
+{
+  float tin = -HUGE_VAL, tout = *t, a, c;
+  int axis = 0;
+
+  if (dx == 0) {
+    if (px < b.x0 || px > b.x1) return 0;
+  } else {
+    a = ((dx > 0 ? b.x0 : b.x1) - px)/dx;
+    c = ((dx > 0 ? b.x1 : b.x0) - px)/dx;
+    if (a > tin) { tin = a; axis = 1; }
+    if (c < tout) tout = c;
+  }
+  if (dy == 0) {
+    if (py < b.y0 || py > b.y1) return 0;
+  } else {
+    a = ((dy > 0 ? b.y0 : b.y1) - py)/dy;
+    c = ((dy > 0 ? b.y1 : b.y0) - py)/dy;
+    if (a > tin) { tin = a; axis = 2; }
+    if (c < tout) tout = c;
+  }
+  /* sweep_box has already dealt with starting inside, so entering a
+     little before the start just means we begin touching */
+  if (axis == 0 || tin > tout || tout < 0 || tin >= *t) {
+    return 0;
+  }
+  *t = tin < 0 ? 0 : tin;
+  return axis;
+}
+
+/* sweep_box finds when a circle of radius r moving from (px, py) by
+   (dx, dy) first touches the box b, the box rounded by r being the
+   union of two slabs and four corner circles.  if that is sooner than
+   *t, *t and the contact normal are updated and TRUE is returned.  a
+   circle that already overlaps the box is stopped at once unless it
+   is moving out of it. */
+int
+sweep_box(float px, float py, float dx, float dy, float r, Box b,
+          float *t, float *nx, float *ny)
+{
+  float qx, qy, ox, oy, d, s = *t;
+  Box e;
+  int axis, hit = FALSE;
+
+  qx = px < b.x0 ? b.x0 : px > b.x1 ? b.x1 : px;
+  qy = py < b.y0 ? b.y0 : py > b.y1 ? b.y1 : py;
+  ox = px - qx;
+  oy = py - qy;
+  d = ox*ox + oy*oy;
+  if (d < r*r*0.999) {
+    if (d > 0) {
+      d = sqrt(d);
+      ox /= d;
+      oy /= d;
+    } else {
+      /* centre inside the box, push out the nearest side */
+      d = px - b.x0; ox = -1; oy = 0;
+      if (b.x1 - px < d) { d = b.x1 - px; ox = 1; oy = 0; }
+      if (py - b.y0 < d) { d = py - b.y0; ox = 0; oy = -1; }
+      if (b.y1 - py < d) { ox = 0; oy = 1; }
+    }
+    if (ox*dx + oy*dy >= 0) {
+      return FALSE;
+    }
+    *t = 0;
+    *nx = ox;
+    *ny = oy;
+    return TRUE;
+  }
+
+  e = b;
+  e.x0 -= r;
+  e.x1 += r;
+  if ((axis=sweep_slab(px, py, dx, dy, e, &s)) != 0) {
+    *nx = axis == 1 ? (dx > 0 ? -1 : 1) : 0;
+    *ny = axis == 2 ? (dy > 0 ? -1 : 1) : 0;
+    hit = TRUE;
+  }
+  e = b;
+  e.y0 -= r;
+  e.y1 += r;
+  if ((axis=sweep_slab(px, py, dx, dy, e, &s)) != 0) {
+    *nx = axis == 1 ? (dx > 0 ? -1 : 1) : 0;
+    *ny = axis == 2 ? (dy > 0 ? -1 : 1) : 0;
+    hit = TRUE;
+  }
+  for (axis=0; axis<4; axis++) {
+    qx = axis & 1 ? b.x1 : b.x0;
+    qy = axis & 2 ? b.y1 : b.y0;
+    if (sweep_circle(px, py, dx, dy, r, qx, qy, &s)) {
+      *nx = (px + s*dx - qx)/r;
+      *ny = (py + s*dy - qy)/r;
+      hit = TRUE;
+    }
+  }
+  *t = s;
+  return hit;
+}
+
+/* sweep_walls finds the first wall a circle of radius r touches while
+   moving from (px, py) by (dx, dy), looking only at the cells under
+   the swept circle.  returns TRUE with the fraction of the move made
+   in *t and the contact normal if one is hit. */
+int
+sweep_walls(Maze *m, float px, float py, float dx, float dy, float r,
+            float *t, float *nx, float *ny)
+{
+  float inv = 1/wall_spacing, x, y;
+  int r0, r1, c0, c1, row, col, mask, hit = FALSE;
+  Box b;
+
+  /* right walls stick out into the next column and bottom walls down
+     into the row below */
+  c0 = floor(((dx < 0 ? px + dx : px) - r - m->xoff)*inv) - 1;
+  c1 = floor(((dx > 0 ? px + dx : px) + r - m->xoff)*inv);
+  r0 = floor(((dy < 0 ? py + dy : py) - r - m->yoff)*inv);
+  r1 = floor(((dy > 0 ? py + dy : py) + r - m->yoff)*inv) + 1;
+  if (c0 < 0) c0 = 0;
+  if (r0 < 0) r0 = 0;
+  if (c1 > m->w - 1) c1 = m->w - 1;
+  if (r1 > m->h - 1) r1 = m->h - 1;
+
+  *t = 1;
+  for (row=r0; row<=r1; row++) {
+    for (col=c0; col<=c1; col++) {
+      mask = m->wallMask[row*m->w + col];
+      x = col*wall_spacing + m->xoff;
+      y = row*wall_spacing + m->yoff;
+      if (mask & WALL_LEFT) {
+        b.x0 = x; b.x1 = x + wall_width;
+        b.y0 = y; b.y1 = y + wall_spacing;
+        hit |= sweep_box(px, py, dx, dy, r, b, t, nx, ny);
+      }
+      if (mask & WALL_BOTTOM) {
+        b.x0 = x; b.x1 = x + wall_spacing;
+        b.y0 = y - wall_width; b.y1 = y;
+        hit |= sweep_box(px, py, dx, dy, r, b, t, nx, ny);
+      }
+      /* the right and top perimeter belong to no cell's left or
+         bottom */
+      if (col == m->w - 1 && (mask & WALL_RIGHT)) {
+        b.x0 = x + wall_spacing; b.x1 = x + wall_spacing + wall_width;
+        b.y0 = y; b.y1 = y + wall_spacing;
+        hit |= sweep_box(px, py, dx, dy, r, b, t, nx, ny);
+      }
+      if (row == m->h - 1 && (mask & WALL_TOP)) {
+        b.x0 = x; b.x1 = x + wall_spacing;
+        b.y0 = y + wall_spacing - wall_width; b.y1 = y + wall_spacing;
+        hit |= sweep_box(px, py, dx, dy, r, b, t, nx, ny);
+      }
+    }
+  }
+  return hit;
+}
+
+/* move_span sets *t0 and *t1 to the part of the move from (px, py) by
+   (dx, dy) during which a circle of radius r could touch a wall, as
+   fractions of the move.  that is the part inside the maze grown by
+   one cell and r on every side.  returns FALSE if there is none. */
+int
+move_span(Maze *m, double px, double py, double dx, double dy, double r,
+          double *t0, double *t1)
+{
+  double lo[2], hi[2], p[2], d[2], a, c;
+  int k;
+
+  lo[0] = m->xoff - wall_spacing - r;
+  hi[0] = m->xoff + (m->w + 1)*wall_spacing + r;
+  lo[1] = m->yoff - wall_spacing - r;
+  hi[1] = m->yoff + (m->h + 1)*wall_spacing + r;
+  p[0] = px; p[1] = py;
+  d[0] = dx; d[1] = dy;
+  *t0 = 0;
+  *t1 = 1;
+  for (k=0; k<2; k++) {
+    if (d[k] == 0) {
+      if (p[k] < lo[k] || p[k] > hi[k]) return FALSE;
+      continue;
+    }
+    a = ((d[k] > 0 ? lo[k] : hi[k]) - p[k])/d[k];
+    c = ((d[k] > 0 ? hi[k] : lo[k]) - p[k])/d[k];
+    if (a > *t0) *t0 = a;
+    if (c < *t1) *t1 = c;
+  }
+  return *t0 <= *t1;
+}
+
+/* collide_move moves a circle of radius r at (*x, *y) by (dx, dy),
+   stopping at walls and sliding along them.  returns TRUE if a wall
+   was touched.  a move that stays inside the clearance box of its
+   cell needs no wall tests.  longer moves are swept in equal pieces of
+   at most half a cell so nothing can be tunnelled through, but only
+   over the part that crosses the maze, so each of the at most three
+   slides costs at most about 2*(w + h + 4) sweeps however long the
+   move is, and 4 sweeps per unit of distance in open corridors. */
+int
+collide_move(Maze *m, GLfloat *x, GLfloat *y, GLfloat dx, GLfloat dy, GLfloat r)
+{
+  double px = *x, py = *y, mx = dx, my = dy, t0, t1, a, b, n, i, s, d;
+  double maxStep = wall_spacing/2;
+  float t, nx, ny;
+  int row, col, slides = 0, hit = FALSE;
+  Box *c;
+
+  if (!isfinite(dx) || !isfinite(dy)) {
+    return FALSE;
+  }
+  col = floor((px - m->xoff)/wall_spacing);
+  row = floor((py - m->yoff)/wall_spacing);
+  if (r <= m->clearRadius && col >= 0 && col < m->w && row >= 0 && row < m->h) {
+    c = m->clearance + row*m->w + col;
+    if (px >= c->x0 && px <= c->x1 && py >= c->y0 && py <= c->y1
+        && px + mx >= c->x0 && px + mx <= c->x1
+        && py + my >= c->y0 && py + my <= c->y1) {
+      *x = px + mx;
+      *y = py + my;
+      return FALSE;
+    }
+  }
+
+  /* each wall hit uses up one of three slides */
+  while (slides < 3 && (mx != 0 || my != 0)) {
+    t = 1;
+    a = b = 1;
+    if (move_span(m, px, py, mx, my, r, &t0, &t1)) {
+      n = ceil(hypot(mx, my)*(t1 - t0)/maxStep);
+      for (i=0; i<n; i++) {
+        a = t0 + (t1 - t0)*i/n;
+        b = t0 + (t1 - t0)*(i + 1)/n;
+        if (sweep_walls(m, px + a*mx, py + a*my, (b - a)*mx, (b - a)*my,
+                        r, &t, &nx, &ny)) {
+          break;
+        }
+      }
+    }
+    if (t >= 1) {
+      px += mx;
+      py += my;
+      break;
+    }
+    hit = TRUE;
+    slides++;
+    /* stop just short of the wall, then keep only the part of the
+       rest of the move that runs along it */
+    s = a + t*(b - a);
+    px += s*mx + nx*1e-4;
+    py += s*my + ny*1e-4;
+    mx *= 1 - s;
+    my *= 1 - s;
+    d = mx*nx + my*ny;
+    if (d < 0) {
+      mx -= d*nx;
+      my -= d*ny;
+    }
+  }
+  *x = px;
+  *y = py;
+  return hit;
+}
+
+/* collide_batch resolves n movement requests against the walls of m,
+   leaving each mover where collide_move puts it */
+void
+collide_batch(Maze *m, MoveRequest *req, int n)
+{
+  int i;
+
+  for (i=0; i<n; i++) {
+    req[i].hit = collide_move(m, &req[i].x, &req[i].y,
+                              req[i].dx, req[i].dy, req[i].radius);
+  }
+}
+
 void
 lightingMaterialReset()
 {
@@ -285,6 +1159,8 @@ void draw_wall(GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2){
   GLfloat xwidth = wall_width*(y2 - y1)/length;
   GLfloat ywidth = wall_width*(x1 - x2)/length;
   int i,j;
+  /* base, then ceiling, both sides, front and back subdivided */
+  frameVertices += 4 + 5*4*numPoints*numPoints;
   glBegin(GL_QUADS);
   
     glColor3f(1,0,0);
@@ -394,30 +1270,14 @@ void draw_wall(GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2){
 }
 
 void
-draw_maze(void)
+draw_maze(Maze *m)
 {
   Point2 *p;
-  int i, j, m, n;
-  GLfloat x1, y1;
-  /* draw the interior edges */
-  for (i=0; i<edges; i++) {
-    if (edge[i].draw == TRUE) {
-      p = vertex + edge[i].vertex1;
-      x1 = p->x;
-      y1 = p->y;
-      p = vertex + edge[i].vertex2;
-      draw_wall(x1,y1,p->x,p->y);
-    }
-  }
-  /* draw the perimeter edges */
-  for (i=0; i<perimeters; i++) {
-    if (perimeter[i].draw == TRUE) {
-      p = vertex + perimeter[i].vertex1;
-      x1 = p->x;
-      y1 = p->y;
-      p = vertex + perimeter[i].vertex2;
-      draw_wall(x1,y1,p->x,p->y);
-    }
+  int i, j;
+  /* draw the walls, interior edges first then the perimeter */
+  for (i=0; i<m->nwalls; i++) {
+    p = m->walls + 2*i;
+    draw_wall(p[0].x,p[0].y,p[1].x,p[1].y);
   }
   
   
@@ -432,17 +1292,18 @@ draw_maze(void)
   glMaterialf(GL_FRONT, GL_SHININESS, mat_shininess);
 
   //Draw floor
-  float xstart = -(w*wall_spacing)/2;
-  float ystart = -(h*wall_spacing)/2;
+  float xstart = -(m->w*wall_spacing)/2;
+  float ystart = -(m->h*wall_spacing)/2;
   
-  float xtot = w*wall_spacing;
-  float ytot = h*wall_spacing;
+  float xtot = m->w*wall_spacing;
+  float ytot = m->h*wall_spacing;
   glBegin(GL_QUADS);
   
   int subDivs = 1000;
   
   float dx = xtot/subDivs;
   float dy = ytot/subDivs;
+  frameVertices += 4*subDivs*subDivs + 4;  /* floor and player marker */
   for(i=0;i<subDivs;i++) {
 	  for(j=0;j<subDivs;j++) {
       glNormal3f(0.0,0.0,1.0);
@@ -482,11 +1343,167 @@ draw_maze(void)
 }
 
 
+/* fill_top_image encodes the walls of the maze as a (2w+1) by (2h+1)
+   image for the top view texture.  even columns and rows hold the
+   vertices and wall lines of the maze, odd ones the cells between
+   them, so texel (2c+1, 2r) is hWalls[r][c] and texel (2c, 2r+1) is
+   vWalls[r][c].  the caller frees the image. */
+GLubyte *
+fill_top_image(Maze *m)
+{
+  GLubyte *image, *t;
+  int i, j, tw = 2*m->w + 1, th = 2*m->h + 1, wall;
+
+  if ((image=malloc((size_t)tw*th*3)) == NULL) {
+    fprintf(stderr, "Could not allocate top view texture\n");
+    exit(1);
+  }
+  for (j=0; j<th; j++) {
+    for (i=0; i<tw; i++) {
+      if (j%2 == 0) {
+        wall = i%2 == 0 || m->hWalls[j/2][i/2];
+      } else {
+        wall = i%2 == 0 && m->vWalls[j/2][i/2];
+      }
+      t = image + 3*((size_t)j*tw + i);
+      t[0] = 0;
+      t[1] = wall ? 0 : 128;
+      t[2] = wall ? 204 : 0;
+    }
+  }
+  return image;
+}
+
+/* top_texture_fits tells whether the top view of m fits in a single
+   texture */
+int
+top_texture_fits(Maze *m)
+{
+  return 2*m->w + 1 <= maxTextureSize && 2*m->h + 1 <= maxTextureSize;
+}
+
+/* build_top_texture fills in the image of m and uploads it.  this is
+   only done when the top view is drawn, and the image is freed once
+   it is in the texture.  returns FALSE if the maze is too big for a
+   single texture. */
+int
+build_top_texture(Maze *m)
+{
+  int tw = 2*m->w + 1, th = 2*m->h + 1;
+  GLubyte *image;
+
+  if (!top_texture_fits(m)) {
+    return FALSE;
+  }
+  image = fill_top_image(m);
+  if (topTexture == 0) {
+    glGenTextures(1, &topTexture);
+  }
+  glBindTexture(GL_TEXTURE_2D, topTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tw, th, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  free(image);
+  return TRUE;
+}
+
+/* draw_top_view draws the maze as a single textured quad for the top
+   down view, falling back on draw_maze if the texture can't be built */
+void
+draw_top_view(Maze *m)
+{
+  /* each texel is half a cell wide and the wall texels are centred
+     on the cell edges, so the quad overhangs the maze by a quarter
+     cell on every side */
+  GLfloat x1 = m->xoff - wall_spacing/4;
+  GLfloat y1 = m->yoff - wall_spacing/4;
+  GLfloat x2 = m->xoff + m->w*wall_spacing + wall_spacing/4;
+  GLfloat y2 = m->yoff + m->h*wall_spacing + wall_spacing/4;
+
+  if (topTextureDirty) {
+    if (!build_top_texture(m)) {
+      draw_maze(m);
+      return;
+    }
+    topTextureDirty = FALSE;
+  }
+
+  frameVertices += 8;
+  glDisable(GL_LIGHTING);
+  glBindTexture(GL_TEXTURE_2D, topTexture);
+  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glBegin(GL_QUADS);
+    glTexCoord2f(0, 0);
+    glVertex3f(x1, y1, 0);
+    glTexCoord2f(1, 0);
+    glVertex3f(x2, y1, 0);
+    glTexCoord2f(1, 1);
+    glVertex3f(x2, y2, 0);
+    glTexCoord2f(0, 1);
+    glVertex3f(x1, y2, 0);
+  glEnd();
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+  /* player marker */
+  glDisable(GL_TEXTURE_2D);
+  glColor3f(1, 0, 0);
+  glBegin(GL_QUADS);
+    glVertex3f(eyeX-.1, eyeY-.1, eyeZ);
+    glVertex3f(eyeX+.1, eyeY-.1, eyeZ);
+    glVertex3f(eyeX+.1, eyeY+.1, eyeZ);
+    glVertex3f(eyeX-.1, eyeY+.1, eyeZ);
+  glEnd();
+  glEnable(GL_TEXTURE_2D);
+  glEnable(GL_LIGHTING);
+}
+
+/* set_camera loads the modelview matrix for the current view */
+void
+set_camera(void)
+{
+  glLoadIdentity();
+  if (topView) {
+    gluLookAt(0.0, 0.0, 15.0, 0.0, 0.0, 9.0, 0.0, 1.0, 0.0);
+  } else {
+    gluLookAt(eyeX,eyeY,eyeZ,eyeX + cos(theta),eyeY + sin(theta),lookZ,0.0,0.0,1.0);
+  }
+}
+
+/* enter_maze puts the player at the entrance of the current maze */
+void
+enter_maze(void)
+{
+  eyeX = maze->col0*wall_spacing+maze->xoff + wall_spacing/2;
+  eyeY = maze->row0*wall_spacing+maze->yoff + wall_spacing/2;
+  lookX = eyeX + 1;
+  lookY = eyeY;
+}
 
 /* standard display function */
 void
 display(void)
 { 
+  Maze *m;
+
+  /* pick up a maze finished by the worker thread.  this is the only
+     place the current maze changes, so nothing is drawing it when it
+     is freed. */
+  if ((m=atomic_exchange(&nextMaze, NULL)) != NULL) {
+    free_maze(maze);
+    maze = m;
+    topTextureDirty = TRUE;
+    enter_maze();
+    set_camera();
+    atomic_store(&generating, 0);
+  }
+
+  frameVertices = 0;
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   
   // GLfloat light1_position[] = {(GLfloat)(eyeX/1000), (GLfloat)(eyeY/1000), (GLfloat)(eyeZ/1000), 1.0};
@@ -507,18 +1524,26 @@ display(void)
     glLightfv(GL_LIGHT1, GL_SPOT_DIRECTION, light1_direction);
     glLightfv(GL_LIGHT1, GL_POSITION, light1_position);
   }
-  draw_maze();
+  if (topView) {
+    draw_top_view(maze);
+  } else {
+    draw_maze(maze);
+  }
   fflush(stdout);
-  glutSwapBuffers();
+  if (benchFile == NULL) {
+    glutSwapBuffers();
+  } else {
+    glFinish();   /* no window to swap, wait for the frame instead */
+  }
 }
 
 void
 printEdges(void) {
 	int i,j;
 	printf("\n\n");
-	  for (i=h-1; i >= 0; i--) {
-		  for (j=0; j < w+1; j++) {
-			  if (vWalls[i][j]) {
+	  for (i=maze->h-1; i >= 0; i--) {
+		  for (j=0; j < maze->w+1; j++) {
+			  if (maze->vWalls[i][j]) {
 				  printf("| ");
 			  } else {
 				  printf("  ");
@@ -527,9 +1552,9 @@ printEdges(void) {
 		  printf("\n");
 	  }
 	  printf("\n\n ");
-	  for (i=h; i >= 0; i--) {
-		  for (j=0; j < w; j++) {
-			  if (hWalls[i][j]) {
+	  for (i=maze->h; i >= 0; i--) {
+		  for (j=0; j < maze->w; j++) {
+			  if (maze->hWalls[i][j]) {
 				  printf("- ");
 			  } else {
 				  printf("  ");
@@ -540,10 +1565,44 @@ printEdges(void) {
 	  fflush(stdout);
 }
 
+/* generate_maze builds a complete w1 by h1 maze along with its tree
+   index and wall list.  if file holds a saved maze of that size it is
+   loaded.  if there is no such file the new maze is saved to it, but
+   an existing file is never overwritten.  no gl calls are made so this
+   can run on the worker thread. */
+Maze *
+generate_maze(int w1, int h1, char *file)
+{
+  Maze *m = init_maze(w1, h1);
+  int loaded = file == NULL ? -2 : load_maze(m, file);
+
+  if (loaded != 0) {
+    /* start again from all walls up after a failed load */
+    if (file != NULL) {
+      free_maze(m);
+      m = init_maze(w1, h1);
+    }
+    while (!m->done) {
+      /* remove one edge */
+      step_maze(m);
+    }
+    build_tree_index(m);
+    if (loaded == -1) {
+      save_maze(m, file);
+    }
+  }
+  build_wall_list(m);
+  build_collision(m, player_radius);
+  return m;
+}
+
 void
-myinit()
+myinit(int w1, int h1)
 {
-  printf("Move around with WASD. Press t for a top down view.\n");
+  if (benchFile == NULL) {
+    printf("Move around with WASD. Press t for a top down view.\n");
+    printf("Press p for the distance back to the entrance.\n");
+  }
   GLfloat light0_ambient[]={0.0, 0.0, 0.0, 1.0};
   GLfloat light0_diffuse[]={0.5, 0.5, 0.5, 1.0};
   GLfloat light0_specular[]={1.0, 1.0, .0, 1.0};
@@ -592,46 +1651,52 @@ myinit()
   glLightfv(GL_LIGHT0, GL_POSITION, light0_position);
   glLightfv(GL_LIGHT1, GL_POSITION, light1_position);
   //glRotatef(-45,1,0,0);
-  /* build maze */
-  init_maze(w, h);
-  while (!done) {
-    /* remove one edge */
-    step_maze();
-  }
+  /* build maze, or load it if a saved one was given */
+  maze = generate_maze(w1, h1, indexFile);
   
   //printEdges();
-  eyeX = col0*wall_spacing+xoff + wall_spacing/2;
-  eyeY = row0*wall_spacing+yoff + wall_spacing/2;
-  lookX = eyeX + 1;
-  lookY = eyeY;
+  enter_maze();
 }
 
-int**
-makeWallArray(int rows, int cols) {
-	int i,j;
-	int** arr;
-    arr = (int**) malloc(rows * sizeof(int*));
-	for (i = 0; i < rows; i++) {
-	   arr[i] = (int *) malloc(cols*sizeof(int));
-	   for (j=0; j < cols; j++){
-		   arr[i][j]=1;
-	   }
-	}
-	return arr;
+/* regenerate is the worker thread started by mouse().  it builds a
+   maze the size of the current one and hands it to display(). */
+void *
+regenerate(void *arg)
+{
+  Maze *m = arg;
+
+  atomic_store(&nextMaze, generate_maze(m->w, m->h, NULL));
+  return NULL;
+}
 
+/* poll_maze checks for a finished maze while the worker is running and
+   asks for a frame to swap it in */
+void
+poll_maze(int value)
+{
+  if (atomic_load(&nextMaze) != NULL) {
+    glutPostRedisplay();
+  } else {
+    glutTimerFunc(50, poll_maze, 0);
+  }
 }
 
 void
 mouse(int btn, int state, int x, int y)
 {
-  /* create a new maze */
-  if ((btn==GLUT_LEFT_BUTTON) && (state==GLUT_DOWN)) {
-    done = 0;
-    init_maze(w, h);
-    while (!done) {
-      step_maze();
+  pthread_t worker;
+
+  /* create a new maze on a worker thread, the current one keeps being
+     drawn until it is done.  only one is built at a time. */
+  if ((btn==GLUT_LEFT_BUTTON) && (state==GLUT_DOWN)
+      && !atomic_exchange(&generating, 1)) {
+    if (pthread_create(&worker, NULL, regenerate, maze) != 0) {
+      fprintf(stderr, "Could not start maze generation\n");
+      atomic_store(&generating, 0);
+    } else {
+      pthread_detach(worker);
+      glutTimerFunc(50, poll_maze, 0);
     }
-    display();
   }
 
   /* exit */
@@ -640,35 +1705,22 @@ mouse(int btn, int state, int x, int y)
   }
 }
 
+/* inCell returns the cell containing the point x, y, or -1 if the
+   point is outside the maze */
 int
-inWall(GLfloat x, GLfloat y){
-  int cellx = floor((x-xoff)/wall_spacing);
-  int celly = floor((y-yoff)/wall_spacing);
-  //printf("%d %d\n",celly,cellx);
-  if(celly >= h || cellx > w || celly < 0 || cellx < 0)
-    return 0;
-  
-  if(cellx < w && hWalls[celly + 1][cellx]){
-    //printf("h wall in cell row: %d col: %d \n",celly,cellx);
-    if((celly + 1)*wall_spacing + yoff - 1.5*wall_width < y)
-      return 1;
-  }
-  
-  if(vWalls[celly][cellx]){
-    //printf("v wall in cell row: %d col: %d \n",celly,cellx);
-    return cellx*wall_spacing + xoff + 1.5*wall_width > x;
-  }
-  //printf("no wall in cell row: %d col: %d \n",celly,cellx);
-  return 0;
+inCell(GLfloat x, GLfloat y){
+  int cellx = floor((x-maze->xoff)/wall_spacing);
+  int celly = floor((y-maze->yoff)/wall_spacing);
+  if(celly >= maze->h || cellx >= maze->w || celly < 0 || cellx < 0)
+    return -1;
+  return celly*maze->w + cellx;
 }
 
 void
 moveInDirection(int direction) {
 	if (!topView) {
-	  if(!inWall(eyeX + stepDistance*direction*cos(theta), eyeY + stepDistance*direction*sin(theta))){
-      eyeX = eyeX + stepDistance*direction*cos(theta);
-      eyeY = eyeY + stepDistance*direction*sin(theta);
-	  }
+	  collide_move(maze, &eyeX, &eyeY, stepDistance*direction*cos(theta),
+	               stepDistance*direction*sin(theta), player_radius);
 	}
 }
 
@@ -680,6 +1732,8 @@ moveInDirection(int direction) {
 void
 keyboard(unsigned char key, int x, int y)
 {
+	int cell;
+
 	switch(key){
 	case 'w':
 		moveInDirection(1);
@@ -702,32 +1756,154 @@ keyboard(unsigned char key, int x, int y)
 	  }
 		break;
 	case 't':
-		if (!topView) {
-			glLoadIdentity();
-			gluLookAt(0.0, 0.0, 15.0, 0.0, 0.0, 9.0, 0.0, 1.0, 0.0);
-			topView = 1;
-		} else {
-			topView = 0;
-		}
+		topView = !topView;
 		break;
+	case 'p':
+	  /* the entrance may be on the far perimeter, one past the last
+	     row or column */
+	  cell = inCell(eyeX, eyeY);
+	  if (cell >= 0) {
+	    printf("%d steps back to the entrance\n",
+	           maze_distance(maze, cell, (maze->row0 < maze->h ? maze->row0 : maze->h-1)*maze->w + (maze->col0 < maze->w ? maze->col0 : maze->w-1)));
+	  }
+	  break;
 	case 27:
 	  // exit if esc is pushed
 	  exit(0);
 	  break;
 	}
-	if (!topView) {
-		glLoadIdentity();
-		gluLookAt(eyeX,eyeY,eyeZ,eyeX + cos(theta),eyeY + sin(theta),lookZ,0.0,0.0,1.0);
+	set_camera();
+	if (recordFile != NULL) {
+		fprintf(recordFile, "%f %f %f %d\n", eyeX, eyeY, theta, topView);
+		fflush(recordFile);
 	}
 	glutPostRedisplay();
 }
 
+/* make_headless_context makes an offscreen mesa context current in
+   place of a glut window.  the surfaceless platform needs no display
+   server, the default display is tried if it isn't available. */
+void
+make_headless_context(int width, int height)
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay;
+  EGLDisplay dpy = EGL_NO_DISPLAY;
+  EGLConfig config;
+  EGLSurface surface;
+  EGLContext context;
+  EGLint major, minor, n;
+  EGLint configAttribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+
+  getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+    eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != NULL) {
+    dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  }
+  if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+    dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+      fprintf(stderr, "Could not initialize EGL\n");
+      exit(1);
+    }
+  }
+  if (!eglChooseConfig(dpy, configAttribs, &config, 1, &n) || n < 1
+      || (surface=eglCreatePbufferSurface(dpy, config, surfaceAttribs)) == EGL_NO_SURFACE
+      || !eglBindAPI(EGL_OPENGL_API)
+      || (context=eglCreateContext(dpy, config, EGL_NO_CONTEXT, NULL)) == EGL_NO_CONTEXT
+      || !eglMakeCurrent(dpy, surface, surface, context)) {
+    fprintf(stderr, "Could not create offscreen context\n");
+    exit(1);
+  }
+}
+
+double
+now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+int
+compareDoubles(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* benchmark replays the camera path in benchFile through display()
+   one frame per line and prints a csv header and summary row */
+void
+benchmark(void)
+{
+  FILE *fp;
+  double *times, *sorted, t, total = 0;
+  long vertices = 0;
+  int frames = 0, size = 256, view;
+  GLfloat x, y, angle;
+
+  if ((fp=fopen(benchFile, "r")) == NULL) {
+    fprintf(stderr, "Could not open %s\n", benchFile);
+    exit(1);
+  }
+  if ((times=malloc(size*sizeof(double))) == NULL) {
+    fprintf(stderr, "Could not allocate frame times\n");
+    exit(1);
+  }
+  while (fscanf(fp, "%f %f %f %d", &x, &y, &angle, &view) == 4) {
+    if (frames == size) {
+      size *= 2;
+      if ((times=realloc(times, size*sizeof(double))) == NULL) {
+        fprintf(stderr, "Could not allocate frame times\n");
+        exit(1);
+      }
+    }
+    eyeX = x;
+    eyeY = y;
+    theta = angle;
+    topView = view;
+    set_camera();
+    t = now();
+    display();
+    times[frames] = now() - t;
+    total += times[frames];
+    vertices += frameVertices;
+    frames++;
+  }
+  fclose(fp);
+  if (frames == 0) {
+    fprintf(stderr, "%s holds no camera path\n", benchFile);
+    exit(1);
+  }
+
+  if ((sorted=malloc(frames*sizeof(double))) == NULL) {
+    fprintf(stderr, "Could not allocate frame times\n");
+    exit(1);
+  }
+  memcpy(sorted, times, frames*sizeof(double));
+  qsort(sorted, frames, sizeof(double), compareDoubles);
+  printf("width,height,seed,frames,fps,p50_ms,p90_ms,p99_ms,max_ms,vertices_per_frame\n");
+  printf("%d,%d,%d,%d,%.2f,%.3f,%.3f,%.3f,%.3f,%ld\n", maze->w, maze->h, seed, frames,
+         frames/total, 1000*sorted[(frames-1)/2], 1000*sorted[(int)(0.9*(frames-1))],
+         1000*sorted[(int)(0.99*(frames-1))], 1000*sorted[frames-1], vertices/frames);
+  free(sorted);
+  free(times);
+}
+
 
 int
 main(int argc, char **argv)
 {
   GLubyte image[64][64][3];
-  int i, j, c;
+  int i, j, c, w1, h1;
   for(i=0;i<64;i++) {
     for(j=0;j<64;j++) {
       c = (((i&0x8)==0)^((j&0x8)==0))*255;
@@ -736,25 +1912,57 @@ main(int argc, char **argv)
       image[i][j][2]= (GLubyte) 120;
     }
   }
+  /* options come before the width and height:
+     -s seed   seed for the maze generator
+     -r file   record the camera path to file
+     -b file   replay the camera path in file headless and report
+               frame times */
+  for (i=1; i+1<argc && argv[i][0]=='-'; i+=2) {
+    switch (argv[i][1]) {
+    case 's':
+      seed = atoi(argv[i+1]);
+      break;
+    case 'r':
+      if ((recordFile=fopen(argv[i+1], "w")) == NULL) {
+        fprintf(stderr, "Could not open %s for writing\n", argv[i+1]);
+        exit(1);
+      }
+      break;
+    case 'b':
+      benchFile = argv[i+1];
+      break;
+    default:
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
   /* check that there are sufficient arguments */
-  if (argc < 3) {
+  if (argc - i < 2) {
     fprintf(stderr, "The width and height must be specified as command line arguments\n");
     exit(1);
   }
-  w = atoi(argv[1]);
-  h = atof(argv[2]);
-  
-  vWalls = makeWallArray(h,w+1);
-  hWalls = makeWallArray(h+1,w);
+  w1 = atoi(argv[i]);
+  h1 = atof(argv[i+1]);
+  /* optional file the maze and its tree index are loaded from, or
+     saved to if it doesn't exist yet */
+  if (argc - i > 2) {
+    indexFile = argv[i+2];
+  }
+  srand(seed);
 
   /* standard initialization */
-  glutInit(&argc, argv);
-  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-  glutInitWindowSize(500, 500);
-  glutCreateWindow("Maze");
-  //glutMouseFunc(mouse);
-  glutKeyboardFunc(keyboard);
-  glutDisplayFunc(display);
+  if (benchFile != NULL) {
+    make_headless_context(500, 500);
+  } else {
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    glutInitWindowSize(500, 500);
+    glutCreateWindow("Maze");
+    glutMouseFunc(mouse);
+    glutKeyboardFunc(keyboard);
+    glutDisplayFunc(display);
+  }
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_TEXTURE_2D);
   glTexImage2D(GL_TEXTURE_2D,0,3,64,64,0,GL_RGB,GL_UNSIGNED_BYTE, image);
@@ -763,7 +1971,11 @@ main(int argc, char **argv)
   glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
   glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
   glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-  myinit();
+  myinit(w1, h1);
+  if (benchFile != NULL) {
+    benchmark();
+    return 0;
+  }
   glutMainLoop();
 
   return 0;